@@ -1,5 +1,6 @@
 #include <msp430.h>
 #include "dht22.h"
+#include "trace.h"
 
 
 // ============================================================================
@@ -73,6 +74,20 @@ inline int read_dht() {
 }
 
 
+// Converts sensor time intervals to sensor bits
+inline void decode_dht() {
+    register unsigned char i;
+
+    // Clear old data
+    for (i = 0; i < 5; i++) { dht.data.bytes[i] = 0; }
+
+    for (i = 0; i < 40; i++) {
+        dht.data.bytes[i >> 3] <<= 1;
+        dht.data.bytes[i >> 3] |= dht.arr[i + 1] > 110;
+    }
+}
+
+
 inline void timerDHT(t) {
     static int cycles;
 
@@ -100,9 +115,14 @@ inline void timerDHT(t) {
             P1REN |= dht.pin;
 
             __disable_interrupt();
+            trace(TRACE_CAPTURE, 0);
             dht.error = read_dht();
+            trace(TRACE_CAPTURED, dht.error);
             __enable_interrupt();
 
+            decode_dht();
+            dht.seq++;
+
             st = 0;
         break;
     }
@@ -110,6 +130,7 @@ inline void timerDHT(t) {
     if(ost ^ st) {
         cycles = 0;
         dht.debug++;
+        trace(TRACE_STATE, (ost << 4) | st);
     }
 }
 
@@ -25,6 +25,7 @@ typedef struct DHT {
     unsigned int arr[41];
     unsigned int tar;   // Timer's value
     int debug;
+    unsigned int seq;   // Number of readings done
 } DHT;
 
 extern DHT dht;
@@ -15,18 +15,32 @@
 //      |                 |
 //      |              CLC|<-- Clock -------------------------------|J1.7   P1.5        |
 //      |              DIN|<-- Data Input --------------------------|J2.15  P1.7        |
-//      |               DC|<-- Data/Command (high/low) -------------|J1.3   P1.1        |
+//      |               DC|<-- Data/Command (high/low) -------------|J1.8   P2.0        |
 //      |               CE|<-- Chip Enable (active low) ------------|J1.2   P1.0        |
 //      |              RST|<-- Reset -------------------------------|J2.16  RST
 // 
 //                                                Onboard button -->|       P1.3
 // 
+//         DHT22
+//       -----------------
+//      |             DATA|<-> Data (remove LED2 jumper J5) --------|J2.14  P1.6        |
+// 
+//         SPI master (register map, see regmap.h)
+//       -----------------
+//      |             MISO|<-- Data from slave ---------------------|J1.3   P1.1        |
+//      |             MOSI|--> Data to slave ---------------------->|J1.4   P1.2        |
+//      |              CLK|--> Clock ------------------------------>|J1.6   P1.4        |
+//      |               CS|--> Chip Select (active low) ----------->|J1.9   P2.1        |
+//      Remove J3 RXD and TXD jumpers, the emulator UART uses P1.1 and P1.2 too
+// 
 // 
 //***************************************************************************************
 
 #include <msp430g2553.h>
 #include "PCD8544.h"
 #include "dht22.h"
+#include "trace.h"
+#include "regmap.h"
 
 #define SET(reg, bits) (reg |= bits)
 #define RST(reg, bits) (reg &= ~bits)
@@ -34,11 +48,11 @@
 #define LCD5110_SCLK_PIN            BIT5
 #define LCD5110_DN_PIN              BIT7
 #define LCD5110_SCE_PIN             BIT0
-#define LCD5110_DC_PIN              BIT1
+#define LCD5110_DC_PIN              BIT0    // Port 2
 #define LCD5110_SELECT              P1OUT &= ~LCD5110_SCE_PIN
 #define LCD5110_DESELECT            P1OUT |= LCD5110_SCE_PIN
-#define LCD5110_SET_COMMAND         P1OUT &= ~LCD5110_DC_PIN
-#define LCD5110_SET_DATA            P1OUT |= LCD5110_DC_PIN
+#define LCD5110_SET_COMMAND         P2OUT &= ~LCD5110_DC_PIN
+#define LCD5110_SET_DATA            P2OUT |= LCD5110_DC_PIN
 #define LCD5110_COMMAND             0
 #define LCD5110_DATA                1
 
@@ -72,7 +86,7 @@ volatile static long cnt2 = 0;
 
 // DHT22 sensor related definitions
 
-DHT dht = { BIT4, &TACCR0};
+DHT dht = { BIT6, &TACCR0};
 // void (*dht_sensor_logic)(DHT*) = dht_logic;
 
 // __attribute__((__interrupt__(PORT1_VECTOR)))
@@ -145,58 +159,46 @@ void setupTimerA0() {
 // }
 
 
+// Called from the main loop, the sensor and SPI interrupts can preempt it
 void updateLCD(void) {
 
-    int i;
-
-    // Convert sensor time intervals to sensor bits
-
-    int byte;
-    // Clear old data
-    for (i = 0; i < 5; i++) { dht.data.bytes[i] = 0; }
+    // Take the last reading, timerDHT() may replace it any time
 
-    for (i = 0; i < 40; i++) {
-        byte = i >> 3;
-        dht.data.bytes[byte] <<= 1;
-        dht.data.bytes[byte] |= dht.arr[i + 1] > 110;
-    }
+    DHT_DATA data;
+    __disable_interrupt();
+    data = dht.data;
+    int error = dht.error;
+    unsigned seq = dht.seq;
+    __enable_interrupt();
 
-    // Check CRC
+    // Check it and publish for the SPI master
 
-    int crc = 0;
-    for (i = 0; i < 4; i++) { crc += dht.data.bytes[i]; }
-    crc &= 0xff;
-    
-    int ok = !dht.error && !(crc ^ dht.data.val.crc);
-    int hum = dht.data.val.hh * 256 + dht.data.val.hl;
-    int temp = dht.data.val.th * 256 + dht.data.val.tl;
+    const REGMAP *m = updateRegmap(&data, error, seq);
+    int ok = m->flags & REGMAP_VALID;
 
     clearLCD();
     writeStringToLCD("T  ");
-    writeStringToLCD(ok? ul2a(temp, buf) : "-");
+    writeStringToLCD(ok? l2a(m->t, buf) : "-");
     writeCharToLCD(0x7f);
     writeCharToLCD('C');
     setAddr(0, 1);
     writeStringToLCD("RH ");
-    writeStringToLCD(ok? ul2a(hum, buf) : "-");
+    writeStringToLCD(ok? ul2a(m->rh, buf) : "-");
     writeCharToLCD('%');
 
-    if (dht.error) {
+    if (m->error) {
         setAddr(0, 2);
         writeStringToLCD("error:");
-        writeStringToLCD(l2a(dht.error, buf));
+        writeStringToLCD(l2a(m->error, buf));
     }
 
-    setAddr(0, 3);
-    static unsigned crc_err = 0;
-    static unsigned dht_err = 0;
-    if (crc ^ dht.data.val.crc) crc_err++;
-    if (dht.error) dht_err++;
-    setAddr(0, 3); writeStringToLCD("crc err: "); writeStringToLCD(l2a(crc_err, buf));
-    setAddr(0, 4); writeStringToLCD("dht err: "); writeStringToLCD(l2a(dht_err, buf));
+    setAddr(0, 3); writeStringToLCD("crc err: "); writeStringToLCD(l2a(m->crc_err, buf));
+    setAddr(0, 4); writeStringToLCD("dht err: "); writeStringToLCD(l2a(m->dht_err, buf));
 
     setAddr(0, 5);
     writeStringToLCD(l2a(dht.debug, buf));
+
+    trace(TRACE_FLUSH, ok);
 }
 
 
@@ -227,8 +229,10 @@ void main(void) {
     */
 
     // Setup pins for LCD
-    P1OUT |= LCD5110_SCE_PIN | LCD5110_DC_PIN;  // Disable LCD, set Data mode
-    P1DIR |= LCD5110_SCE_PIN | LCD5110_DC_PIN;  // Set pins to output direction
+    P1OUT |= LCD5110_SCE_PIN;   // Disable LCD
+    P1DIR |= LCD5110_SCE_PIN;   // Set pin to output direction
+    P2OUT |= LCD5110_DC_PIN;    // Set Data mode
+    P2DIR |= LCD5110_DC_PIN;    // Set pin to output direction
 
     // Setup USIB
     P1SEL |= LCD5110_SCLK_PIN | LCD5110_DN_PIN;
@@ -249,11 +253,16 @@ void main(void) {
     writeStringToLCD("MSP-430G2553-3");
 
     setupTimerA0();
+    setupRegmap();
 
     __enable_interrupt();
 
-    _BIS_SR(LPM0_bits);     // Enter LPM0
-    // _BIS_SR(LPM3_bits);     // TODO: Enter LPM3 (use ACLK)
+    // Draw outside of interrupts, so they are not held off by the LCD
+    while (1) {
+        _BIS_SR(LPM0_bits);     // Enter LPM0, the timer wakes up once per second
+        // _BIS_SR(LPM3_bits);     // TODO: Enter LPM3 (use ACLK)
+        updateLCD();
+    }
 
 } // eof main
 
@@ -415,8 +424,23 @@ isrTimerA0_IV(void) {
             // Use counter to get 1 sec interval
             if (++i > 99) {
                 i = 0;
-                updateLCD();
+                timerRegmap();
+                LPM0_EXIT;      // Let main() update the LCD
             }
         break;
     }
 }
+
+
+// USCI A0/B0 receive interrupt, only A0 is enabled
+__attribute__((__interrupt__(USCIAB0RX_VECTOR)))
+isrUSCIAB0RX(void) {
+    rxRegmap();
+}
+
+
+// Port 2 interrupt
+__attribute__((__interrupt__(PORT2_VECTOR)))
+isrPort2(void) {
+    csRegmap();
+}
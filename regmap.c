@@ -0,0 +1,133 @@
+#include <msp430.h>
+#include "regmap.h"
+#include "trace.h"
+
+#define REGMAP_SOMI_PIN     BIT1    // Port 1
+#define REGMAP_SIMO_PIN     BIT2    // Port 1
+#define REGMAP_CLK_PIN      BIT4    // Port 1
+#define REGMAP_CS_PIN       BIT1    // Port 2
+
+
+// ============================================================================
+
+/*
+Two snapshots: the master reads the front one, the firmware fills the other.
+Publishing swaps the front index only. Snapshots are published once per
+reading (~2 s), so the one being served is never refilled in the middle of
+a transaction.
+
+The sample age is the only register which changes without publishing. It is
+updated in the front snapshot once per transaction, before the first byte is
+sent, along with the sum.
+*/
+
+static REGMAP map[2];
+static volatile unsigned char front;    // Index of the snapshot being served
+static unsigned int stamp[2];           // Uptime the snapshot was published at
+static unsigned int uptime;             // Seconds
+
+const unsigned char *regmap_regs;
+unsigned char regmap_addr;
+
+
+void setupRegmap() {
+    UCA0CTL1 = UCSWRST;                 // Keep in reset while CS is high
+    UCA0CTL0 = UCCKPH | UCMSB | UCSYNC; // 3-pin, 8-bit SPI slave
+
+    // SOMI is selected while CS is low only, see csRegmap()
+    P1SEL |= REGMAP_SIMO_PIN | REGMAP_CLK_PIN;
+    P1SEL2 |= REGMAP_SIMO_PIN | REGMAP_CLK_PIN;
+
+    P2DIR &= ~REGMAP_CS_PIN;            // Set pin to input direction
+    P2OUT |= REGMAP_CS_PIN;             // Pull up
+    P2REN |= REGMAP_CS_PIN;
+    P2IES |= REGMAP_CS_PIN;             // Interrupt on high-to-low edge
+    P2IFG &= ~REGMAP_CS_PIN;
+    P2IE |= REGMAP_CS_PIN;
+}
+
+
+const REGMAP* updateRegmap(const DHT_DATA *d, int error, unsigned int seq) {
+    REGMAP *f = &map[front];
+    REGMAP *m = &map[front ^ 1];
+    unsigned char *p = (unsigned char*)m;
+    unsigned char i;
+    unsigned char crc = 0;
+    char sum = 0;
+
+    if (seq == f->seq) return f;        // Nothing new
+
+    for (i = 0; i < 5; i++) { m->raw.bytes[i] = d->bytes[i]; }
+    for (i = 0; i < 4; i++) { crc += d->bytes[i]; }
+    m->flags = !error && crc == (unsigned char)d->val.crc ? REGMAP_VALID : 0;
+
+    // Sensor sends the magnitude and the sign bit
+    m->t = (d->val.th & 0x7f) << 8 | (unsigned char)d->val.tl;
+    if (d->val.th & 0x80) { m->t = -m->t; }
+    m->rh = (unsigned char)d->val.hh << 8 | (unsigned char)d->val.hl;
+
+    // Count errors once per reading
+    m->crc_err = f->crc_err;
+    m->dht_err = f->dht_err;
+    if (crc ^ (unsigned char)d->val.crc) { m->crc_err++; trace(TRACE_CRC, crc); }
+    if (error) { m->dht_err++; }
+
+    m->seq = seq;
+    m->error = error;
+    m->age = 0;
+    m->sum = 0;
+    for (i = 0; i < sizeof(REGMAP); i++) { sum += p[i]; }
+    m->sum = -sum;
+
+    register unsigned int sr = __get_SR_register();
+    __disable_interrupt();              // Stamp and swap at once
+    stamp[front ^ 1] = uptime;
+    front ^= 1;
+    __bis_SR_register(sr & GIE);
+
+    return m;
+}
+
+
+void timerRegmap() {
+    uptime++;
+}
+
+
+void beginRegmap(unsigned char addr) {
+    REGMAP *m = &map[front];
+    unsigned int age = uptime - stamp[front];
+    m->sum += (m->age & 0xff) + (m->age >> 8) - (age & 0xff) - (age >> 8);
+    m->age = age;
+    regmap_regs = (const unsigned char*)m;
+    regmap_addr = addr;
+}
+
+
+void csRegmap() {
+    unsigned char cs;
+
+    if (!(P2IFG & REGMAP_CS_PIN)) return;
+
+    // Take the level from the pin, the interrupt may come late and miss an
+    // edge. Arm the opposite edge, and repeat if the pin changed meanwhile.
+    do {
+        cs = P2IN & REGMAP_CS_PIN;
+        if (cs) { P2IES |= REGMAP_CS_PIN; } else { P2IES &= ~REGMAP_CS_PIN; }
+        P2IFG &= ~REGMAP_CS_PIN;        // Changing P2IES may set it
+    } while ((P2IN & REGMAP_CS_PIN) ^ cs);
+
+    UCA0CTL1 |= UCSWRST;                // Drop a partial byte, if any
+
+    if (!cs) {                          // CS is low, transaction begins
+        regmap_regs = 0;
+        P1SEL |= REGMAP_SOMI_PIN;       // Drive SOMI
+        P1SEL2 |= REGMAP_SOMI_PIN;
+        UCA0CTL1 &= ~UCSWRST;
+        UCA0TXBUF = 0xff;               // Answer to the address byte
+        IE2 |= UCA0RXIE;                // Reset clears it
+    } else {                            // CS is high, release SOMI for others
+        P1SEL &= ~REGMAP_SOMI_PIN;      // Input, P1DIR bit is clear
+        P1SEL2 &= ~REGMAP_SOMI_PIN;
+    }
+}
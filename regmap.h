@@ -0,0 +1,96 @@
+#ifndef __REGMAP_H__
+#define __REGMAP_H__
+
+#include <stdint.h>
+#include <msp430.h>
+#include "dht22.h"
+
+
+// SPI slave register map, served on USCI_A0
+
+/*
+Pins:
+    P1.1    UCA0SOMI    data to the master
+    P1.2    UCA0SIMO    data from the master
+    P1.4    UCA0CLK     clock from the master, SPI mode 0, MSB first
+    P2.1    CS          chip select from the master, active low
+
+SOMI is released (input) while CS is high, so the bus can be shared.
+
+On MSP-EXP430G2 remove J3 RXD and TXD jumpers, the emulator UART uses
+P1.1 and P1.2 too.
+
+Transaction:
+    CS low, master sends the register address, then clocks out the registers
+    sending any bytes. The slave answers 0xFF to the address byte and past the
+    end of the map. CS high ends the transaction.
+    The slave loads each byte in an interrupt, so the master must wait:
+        150 us  after CS goes low, before the address byte
+        250 us  after the address byte, the snapshot is taken then
+        150 us  after each data byte
+    These are estimated from the instruction count at 1 MHz MCLK, not
+    measured: ~70 cycles for CS, ~130 for the address byte and ~60 for a data
+    byte, plus up to ~100 cycles for a timer interrupt served first.
+
+The whole transaction is served from one snapshot. The bytes of the map sum up
+to zero (mod 256). The slave can't answer for ~6 ms every 2 s while it reads
+the sensor with interrupts disabled, a byte clocked then is lost or repeated.
+So only full map reads can be validated: read all of it and repeat the
+transaction if the sum is not zero. Partial reads are not checked.
+
+Registers, little-endian:
+    addr    size    field
+    -----------------------------------------
+    0x00    5       raw sensor data, see DHT_DATA
+    0x05    1       flags, bit 0 - the reading is valid
+    0x06    2       temperature, 0.1 C, signed
+    0x08    2       relative humidity, 0.1 %
+    0x0A    2       sample sequence number
+    0x0C    2       checksum errors count
+    0x0E    2       sensor errors count
+    0x10    2       last sensor error, see read_dht()
+    0x12    2       sample age, seconds
+    0x14    1       reserved
+    0x15    1       sum, makes the sum of all bytes zero
+*/
+
+#define REGMAP_VALID    0x01
+
+// Fixed size types, so the layout is the same on the host simulator
+typedef struct REGMAP {
+    DHT_DATA raw;
+    char flags;
+    int16_t t;
+    int16_t rh;
+    uint16_t seq;
+    uint16_t crc_err;
+    uint16_t dht_err;
+    int16_t error;
+    uint16_t age;
+    char reserved;
+    char sum;
+} REGMAP;
+
+void setupRegmap();
+
+// Publishes the reading if seq is new, counts its errors.
+// Returns the latest snapshot, for the LCD.
+const REGMAP* updateRegmap(const DHT_DATA *d, int error, unsigned int seq);
+
+void timerRegmap();     // Call it once per second
+void csRegmap();        // Call it on Port 2 interrupt
+
+// Transaction state, see rxRegmap()
+extern const unsigned char *regmap_regs;    // Snapshot being served, 0 - no address yet
+extern unsigned char regmap_addr;           // Address of the next register to send
+
+void beginRegmap(unsigned char addr);       // Takes the snapshot
+
+// Call it on USCI_A0 receive interrupt. Inline, so a data byte costs no call.
+static inline void rxRegmap() {
+    unsigned char c = UCA0RXBUF;
+    if (!regmap_regs) { beginRegmap(c); }
+    UCA0TXBUF = regmap_addr < sizeof(REGMAP) ? regmap_regs[regmap_addr++] : 0xff;
+}
+
+#endif
@@ -0,0 +1,180 @@
+// SPI master stub for the register map, runs on the host.
+// Build and run with `make sim`.
+
+#include <stdio.h>
+#include <msp430.h>
+#include "regmap.h"
+
+unsigned char UCA0CTL0, UCA0CTL1, UCA0RXBUF, UCA0TXBUF, IE2;
+unsigned char P1SEL, P1SEL2;
+unsigned char P2IN = BIT1, P2DIR, P2OUT, P2REN, P2IES, P2IFG, P2IE;
+
+static int failed = 0;
+
+#define CHECK(x) if (!(x)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #x); failed++; }
+
+
+// ============================================================================
+//
+// Bus model
+//
+
+// Drives CS and latches the port interrupt flag on the selected edge
+static void pin(int level) {
+    int edge = (P2IES & BIT1) ? !level : level;
+    if (edge && ((P2IN & BIT1) != 0) != level) { P2IFG |= BIT1; }
+    P2IN = level ? BIT1 : 0;
+}
+
+// Drives CS and runs the port interrupt
+static void cs(int level) {
+    pin(level);
+    if (P2IE & BIT1) { csRegmap(); }
+}
+
+// Clocks one byte in both directions
+static unsigned char xfer(unsigned char c) {
+    if (!(P1SEL & P1SEL2 & BIT1)) { return 0xff; }  // SOMI is not driven
+    if (UCA0CTL1 & UCSWRST) { return 0xff; }
+    unsigned char miso = UCA0TXBUF;             // Goes to the shift register
+    UCA0RXBUF = c;
+    if (IE2 & UCA0RXIE) { rxRegmap(); }
+    return miso;
+}
+
+// Reads n registers starting at addr
+static void readRegs(unsigned char addr, void *buf, int n) {
+    unsigned char *p = buf;
+    cs(0);
+    CHECK(xfer(addr) == 0xff);
+    while (n--) { *p++ = xfer(0); }
+    cs(1);
+}
+
+static unsigned char sum(const void *buf, int n) {
+    const unsigned char *p = buf;
+    unsigned char s = 0;
+    while (n--) { s += *p++; }
+    return s;
+}
+
+
+// ============================================================================
+//
+// Scenarios
+//
+
+// Passes raw sensor bytes to the register map the way updateLCD() does
+static const REGMAP* sample(const char *raw, int error, unsigned seq) {
+    DHT_DATA d;
+    int i;
+    for (i = 0; i < 5; i++) { d.bytes[i] = raw[i]; }
+    return updateRegmap(&d, error, seq);
+}
+
+// Reads the whole map and checks the sum
+static void readMap(REGMAP *r) {
+    readRegs(0, r, sizeof(*r));
+    CHECK(sum(r, sizeof(*r)) == 0);
+}
+
+// RH 65.2 %, T -10.1 C
+static const char cold[] = { 0x02, 0x8c, 0x80, 0x65, 0x73 };
+// RH 40.1 %, T 23.5 C
+static const char warm[] = { 0x01, 0x91, 0x00, 0xeb, 0x7d };
+static const char warm_bad_crc[] = { 0x01, 0x91, 0x00, 0xeb, 0x7e };
+
+int main(void) {
+    REGMAP r;
+
+    setupRegmap();
+
+    // Nothing published yet, the map is empty but consistent
+    readRegs(0, &r, sizeof(r));
+    CHECK(sum(&r, sizeof(r)) == 0);
+    CHECK(r.seq == 0);
+
+    // Full map read, negative temperature
+    const REGMAP *m = sample(cold, 0, 1);
+    CHECK(m->t == -101 && (m->flags & REGMAP_VALID));
+    timerRegmap();
+    timerRegmap();
+    readMap(&r);
+    CHECK(r.t == -101);
+    CHECK(r.rh == 652);
+    CHECK(r.seq == 1);
+    CHECK(r.crc_err == 0 && r.dht_err == 0);
+    CHECK(r.age == 2);
+    CHECK(r.flags & REGMAP_VALID);
+    CHECK(r.error == 0);
+    CHECK(r.raw.val.th == cold[2] && r.raw.val.crc == cold[4]);
+    printf("T %d.%d C, RH %d.%d %%, seq %u, age %u s\n",
+        r.t / 10, (r.t < 0 ? -r.t : r.t) % 10, r.rh / 10, r.rh % 10, r.seq, r.age);
+
+    // Partial read, and past the end of the map. Partial reads are not checked
+    unsigned char b[4];
+    readRegs(0x12, b, 4);
+    CHECK(b[0] == 2 && b[1] == 0);
+    CHECK(b[2] == 0 && b[3] != 0xff);
+    readRegs(sizeof(REGMAP), b, 2);
+    CHECK(b[0] == 0xff && b[1] == 0xff);
+
+    // A new sample published in the middle of a transaction is not mixed in
+    unsigned char *p = (unsigned char*)&r;
+    int i;
+    cs(0);
+    xfer(0);
+    for (i = 0; i < 8; i++) { *p++ = xfer(0); }
+    sample(warm, 0, 2);
+    for (; i < sizeof(r); i++) { *p++ = xfer(0); }
+    cs(1);
+    CHECK(sum(&r, sizeof(r)) == 0);
+    CHECK(r.seq == 1 && r.t == -101);
+
+    readMap(&r);
+    CHECK(r.seq == 2 && r.t == 235 && r.rh == 401 && r.age == 0);
+    CHECK(r.flags & REGMAP_VALID);
+
+    // Bad checksum and sensor error make the reading invalid and are counted
+    sample(warm_bad_crc, 0, 3);
+    readMap(&r);
+    CHECK(r.seq == 3 && !(r.flags & REGMAP_VALID));
+    CHECK(r.crc_err == 1 && r.dht_err == 0);
+    sample(warm, -2, 4);
+    readMap(&r);
+    CHECK(r.seq == 4 && !(r.flags & REGMAP_VALID) && r.error == -2);
+    CHECK(r.crc_err == 1 && r.dht_err == 1);
+
+    // The LCD shows the same reading again, it is not counted twice
+    timerRegmap();
+    m = sample(warm, -2, 4);
+    CHECK(m->seq == 4 && m->dht_err == 1);
+    readMap(&r);
+    CHECK(r.dht_err == 1 && r.age == 1);
+
+    // SOMI is driven while CS is low only
+    CHECK(!(P1SEL & BIT1) && !(P1SEL2 & BIT1));
+    cs(0);
+    CHECK((P1SEL & BIT1) && (P1SEL2 & BIT1));
+    cs(1);
+    CHECK(!(P1SEL & BIT1) && !(P1SEL2 & BIT1));
+
+    // A partial byte dropped by CS is not carried to the next transaction
+    cs(0);
+    cs(1);
+    readRegs(0x0A, b, 2);
+    CHECK(b[0] == 4 && b[1] == 0);
+
+    // A CS pulse missed while interrupts were held off leaves the slave idle
+    pin(0);
+    pin(1);
+    csRegmap();
+    CHECK(UCA0CTL1 & UCSWRST);
+    CHECK(P2IES & BIT1);
+    CHECK(!(P1SEL & BIT1));
+    readMap(&r);
+    CHECK(r.seq == 4);
+
+    printf(failed ? "FAILED\n" : "OK\n");
+    return failed != 0;
+}
@@ -0,0 +1,27 @@
+#ifndef __SIM_MSP430_H__
+#define __SIM_MSP430_H__
+
+
+// Host stand-in for the MSP430 registers used by regmap.c
+
+extern unsigned char UCA0CTL0, UCA0CTL1, UCA0RXBUF, UCA0TXBUF, IE2;
+extern unsigned char P1SEL, P1SEL2;
+extern unsigned char P2IN, P2DIR, P2OUT, P2REN, P2IES, P2IFG, P2IE;
+
+#define BIT1        0x02
+#define BIT2        0x04
+#define BIT4        0x10
+
+#define UCCKPH      0x80
+#define UCMSB       0x20
+#define UCSYNC      0x01
+#define UCSWRST     0x01
+#define UCA0RXIE    0x01
+
+#define GIE         0x08
+
+#define __get_SR_register()     GIE
+#define __disable_interrupt()
+#define __bis_SR_register(x)    ((void)(x))
+
+#endif
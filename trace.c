@@ -0,0 +1,7 @@
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+TRACE trace_ring;
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+
+// Binary event trace ring for state machine debugging
+
+/*
+Enable with `make clear; make TRACE=1`, the objects are not rebuilt when the
+flags change. Set the number of entries with TRACE_SIZE=n, a power of 2.
+When disabled, trace() compiles to nothing.
+
+The ring is a plain RAM structure `trace_ring`. Dump it with `make trace`
+(mspdebug) or `print/x trace_ring` in gdb. The dump must not reset or reload
+the target, the startup code clears the ring. Layout, little-endian:
+
+    offset  size    field
+    -----------------------------------------
+    0       2       total number of recorded events (free running)
+    2       4 * N   entries, N = TRACE_SIZE
+
+Entry:
+    0       2       TAR at the moment of the event, 1 us per tick
+    2       1       event code, see TRACE_EV
+    3       1       event argument
+
+The oldest entry is at index (count % N) once the ring has wrapped.
+TAR wraps every ~65 ms, so timestamps are meaningful between the adjacent
+events only.
+*/
+
+// Event codes
+typedef enum TRACE_EV {
+    TRACE_NONE = 0,
+    TRACE_STATE,        // timerDHT transition, arg = (old << 4) | new
+    TRACE_CAPTURE,      // Start of the sensor reading
+    TRACE_CAPTURED,     // End of the sensor reading, arg = read_dht() result,
+                        // e.g. 0xfe = -2
+    TRACE_CRC,          // Checksum mismatch of a new reading, arg = computed checksum
+    TRACE_FLUSH,        // LCD updated, arg = 1 if the reading was valid
+} TRACE_EV;
+
+#ifdef TRACE_ENABLED
+
+#include <msp430.h>
+
+#ifndef TRACE_SIZE
+#define TRACE_SIZE  16  // Number of entries, must be a power of 2
+#endif
+#if TRACE_SIZE & (TRACE_SIZE - 1)
+#error "TRACE_SIZE must be a power of 2"
+#endif
+
+typedef struct TRACE_ENTRY {
+    unsigned int tar;
+    unsigned char ev;
+    unsigned char arg;
+} TRACE_ENTRY;
+
+typedef struct TRACE {
+    unsigned int count;
+    TRACE_ENTRY e[TRACE_SIZE];
+} TRACE;
+
+extern TRACE trace_ring;
+
+// Records an event. Safe to call with interrupts enabled.
+static inline void trace(unsigned char ev, unsigned char arg) {
+    register unsigned int sr = __get_SR_register();
+    __disable_interrupt();
+    register TRACE_ENTRY *p = &trace_ring.e[trace_ring.count++ & (TRACE_SIZE - 1)];
+    p->tar = TAR;
+    p->ev = ev;
+    p->arg = arg;
+    __bis_SR_register(sr & GIE);
+}
+
+#else
+
+#define trace(ev, arg)
+
+#endif
+
+#endif